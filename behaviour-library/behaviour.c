@@ -6,7 +6,8 @@
 #include <string.h>
 
 #define TYPE_LABELS \
-    (const char *[5]) { "Leaf", "Fallback", "Sequence", "Repeater", "Inverter" }
+    (const char *[10]) { "Leaf", "Fallback", "Sequence", "Repeater", "Inverter", "Wait", "Timeout", "Cooldown", \
+                         "Reactive sequence", "Reactive fallback" }
 
 /* -------------------------------------------------------------------------- */
 /*                       behaviour node standard actions                      */
@@ -17,7 +18,7 @@ extern int behaviour_node_internal_move_focus(void *node_handle)
     Node *node = (Node *)node_handle;
     if (!node->is_root_node)
     {
-        ASSERT_MSG(node->root == NULL, "Cannot move root focus as root is unassigned");
+        CHECK_MSG(node->root == NULL, "Cannot move root focus as root is unassigned");
     }
     else
     {
@@ -32,9 +33,16 @@ extern int behaviour_node_internal_move_focus(void *node_handle)
 extern int behaviour_node_internal_standard_start(void *node_handle)
 {
     Node *node = (Node *)node_handle;
+#ifndef BEHAVIOUR_UNCHECKED
     NodeType type = node->type;
     switch (type)
     {
+    case NT_WAIT:
+    case NT_TIMEOUT:
+    case NT_COOLDOWN:
+        ASSERT_MSG(((TimerNode *)node)->wheel == NULL, "Cannot execute timer node with no timing wheel");
+        ASSERT_MSG(((TimerNode *)node)->child == NULL, "Cannot execute timer node with no children");
+        break;
     case NT_REPEATER:
         ASSERT_MSG(((RepeaterNode *)node)->starting_repetitions == 0, "Repeater starting repetitions must be >= 0 to execute");
     case NT_INVERTER:
@@ -42,12 +50,15 @@ extern int behaviour_node_internal_standard_start(void *node_handle)
         break;
     case NT_SEQUENCE:
     case NT_FALLBACK:
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
         ASSERT_MSG(((CompositeNode *)node)->child_count == 0, "Cannot execute composite node with no children");
         break;
     default:
         ASSERT_MSG(node->tick == NULL, "Cannot execute leaf node will unallocated tick function!");
         break;
     }
+#endif
     node->state = NS_UNDETERMINED;
     return 1;
 }
@@ -69,11 +80,7 @@ extern int behaviour_node_internal_decorator_tick(void *node_handle)
         {
             void *temp = child->root;
             behaviour_tree_reset(child);
-            behaviour_node_internal_recursive_dispatcher(
-                behaviour_node_internal_set_root,
-                child,
-                temp,
-                NULL);
+            behaviour_tree_visit(child, TO_PRE_ORDER, -1, behaviour_node_internal_set_root, temp);
             behaviour_node_internal_move_focus(child);
             ((RepeaterNode *)node)->repetitions--;
             node->tick(node);
@@ -93,10 +100,240 @@ extern int behaviour_node_internal_decorator_tick(void *node_handle)
     return -1;
 }
 
+extern int behaviour_node_internal_timer_start(void *node_handle)
+{
+    Node *node = (Node *)node_handle;
+    TimerNode *timer = (TimerNode *)node_handle;
+
+    behaviour_node_internal_standard_start(node);
+    switch (node->type)
+    {
+    case NT_WAIT:
+        behaviour_wheel_internal_schedule(timer->wheel, &timer->entry, timer->wheel->now + timer->duration);
+        ((Node *)node->root)->parked = 1;
+        break;
+    case NT_TIMEOUT:
+        behaviour_wheel_internal_schedule(timer->wheel, &timer->entry, timer->wheel->now + timer->duration);
+        break;
+    default:
+        if (timer->wheel->now < timer->ready_at)
+            node->state = NS_FAILED;
+        break;
+    }
+    return 1;
+}
+
+extern int behaviour_node_internal_timer_tick(void *node_handle)
+{
+    Node *node = (Node *)node_handle;
+    TimerNode *timer = (TimerNode *)node_handle;
+    Node *child = timer->child;
+
+    if (child->state == NS_PENDING)
+    {
+        // a wait only lets its child start once the wheel has expired (unlinked) its entry.
+        if (node->type == NT_WAIT && timer->entry.next != NULL)
+            return 0;
+        behaviour_node_internal_move_focus(child);
+        return 1;
+    }
+
+    if (node->type == NT_TIMEOUT)
+        behaviour_wheel_internal_cancel(&timer->entry);
+    else if (node->type == NT_COOLDOWN)
+        timer->ready_at = timer->wheel->now + timer->duration;
+    node->state = child->state;
+    return 1;
+}
+
+extern int behaviour_node_internal_timer_expire(Node *node_handle)
+{
+    Node *root = node_handle->root;
+    TimingWheel *wheel = ((TimerNode *)node_handle)->wheel;
+
+    if (node_handle->type == NT_TIMEOUT)
+    {
+        behaviour_node_internal_preempt(((TimerNode *)node_handle)->child);
+        node_handle->state = NS_FAILED;
+        behaviour_node_internal_move_focus(node_handle);
+    }
+
+    if (root->parked)
+    {
+        root->parked = 0;
+        wheel->woken++;
+        if (wheel->wake != NULL)
+            wheel->wake(root, wheel->wake_data);
+    }
+    return 1;
+}
+
+extern int behaviour_node_internal_preempt(Node *node_handle)
+{
+    Node *focus = ((Node *)node_handle->root)->currently_executing;
+    Node *ancestor = focus;
+
+    // only a leaf that has been started, and is beneath the preempted node, gets its stop action.
+    while (ancestor != NULL && ancestor != node_handle)
+        ancestor = ancestor->parent;
+    if (ancestor != NULL && focus->type == NT_LEAF && focus->state != NS_PENDING)
+    {
+        if (((LeafNode *)focus)->configured_stop != NULL)
+            ((LeafNode *)focus)->configured_stop(focus);
+    }
+
+    behaviour_tree_visit(node_handle, TO_PRE_ORDER, -1, behaviour_node_internal_abort_state, NULL);
+    return 1;
+}
+
+extern int behaviour_node_internal_start_observing(ReactiveNode *node_handle, int running_child)
+{
+    Node *root = ((Node *)node_handle)->root;
+    ReactiveNode *observer;
+
+    node_handle->running_child = running_child;
+    node_handle->ticks_until_check = node_handle->guard_rate;
+    if (node_handle->guard_version != NULL)
+        node_handle->seen_version = *node_handle->guard_version;
+    if (node_handle->observing)
+        return 1;
+
+    // observers are only ever added from inside the focus path, so the newest is always the furthest in.
+    node_handle->observing = 1;
+    node_handle->next_observer = NULL;
+    if (root->observers == NULL)
+    {
+        root->observers = node_handle;
+        return 1;
+    }
+    for (observer = root->observers; observer->next_observer != NULL; observer = observer->next_observer)
+        ;
+    observer->next_observer = node_handle;
+    return 1;
+}
+
+extern int behaviour_node_internal_stop_observing(ReactiveNode *node_handle)
+{
+    Node *root = ((Node *)node_handle)->root;
+    ReactiveNode *observer;
+    ReactiveNode *next;
+
+    if (!node_handle->observing)
+        return 0;
+
+    if (root != NULL && root->observers == node_handle)
+    {
+        root->observers = NULL;
+    }
+    else if (root != NULL)
+    {
+        for (observer = root->observers; observer != NULL; observer = observer->next_observer)
+        {
+            if (observer->next_observer == node_handle)
+            {
+                observer->next_observer = NULL;
+                break;
+            }
+        }
+    }
+
+    for (observer = node_handle; observer != NULL; observer = next)
+    {
+        next = observer->next_observer;
+        observer->observing = 0;
+        observer->next_observer = NULL;
+    }
+    return 1;
+}
+
+extern NodeState behaviour_node_internal_evaluate_guard(Node *node_handle)
+{
+    NodeState previous = node_handle->state;
+    NodeState result;
+    int i;
+
+    switch (node_handle->type)
+    {
+    case NT_LEAF:
+        node_handle->tick(node_handle);
+        if (node_handle->state == NS_UNDETERMINED)
+        {
+            node_handle->state = previous;
+            return NS_UNDETERMINED;
+        }
+        return node_handle->state;
+    case NT_INVERTER:
+        result = behaviour_node_internal_evaluate_guard(((DecoratorNode *)node_handle)->child);
+        if (result == NS_UNDETERMINED)
+            return result;
+        result = (result == NS_SUCCEEDED) ? NS_FAILED : NS_SUCCEEDED;
+        break;
+    default:
+        // sequences and fallbacks, reactive or not. Only subtrees finalize marked evaluable are guards.
+        result = (node_handle->type == NT_SEQUENCE || node_handle->type == NT_REACTIVE_SEQUENCE) ? NS_SUCCEEDED : NS_FAILED;
+        for (i = 0; i < ((CompositeNode *)node_handle)->child_count; i++)
+        {
+            NodeState child_result = behaviour_node_internal_evaluate_guard(((CompositeNode *)node_handle)->children[i]);
+            if (child_result == NS_UNDETERMINED)
+                return child_result;
+            if (child_result != result)
+            {
+                result = child_result;
+                break;
+            }
+        }
+        break;
+    }
+    node_handle->state = result;
+    return result;
+}
+
+extern int behaviour_node_internal_check_observers(Node *root_node_handle)
+{
+    ReactiveNode *observer;
+
+    for (observer = root_node_handle->observers; observer != NULL; observer = observer->next_observer)
+    {
+        Node *node = (Node *)observer;
+        NodeState abort_state = (node->type == NT_REACTIVE_SEQUENCE) ? NS_FAILED : NS_SUCCEEDED;
+        int due = 0;
+        int i;
+
+        if (observer->guard_version != NULL && *observer->guard_version != observer->seen_version)
+            due = 1;
+        if (observer->guard_rate > 0 && --observer->ticks_until_check <= 0)
+            due = 1;
+        if (!due)
+            continue;
+
+        observer->ticks_until_check = observer->guard_rate;
+        if (observer->guard_version != NULL)
+            observer->seen_version = *observer->guard_version;
+
+        // a guard that doesn't resolve straight away is inconclusive, and left as it was.
+        for (i = 0; i < observer->running_child; i++)
+        {
+            if (!observer->children[i]->evaluable)
+                continue;
+            if (behaviour_node_internal_evaluate_guard(observer->children[i]) == abort_state)
+            {
+                behaviour_node_internal_preempt(observer->children[observer->running_child]);
+                behaviour_node_internal_stop_observing(observer);
+                node->state = abort_state;
+                behaviour_node_internal_move_focus(node);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 extern int behaviour_node_internal_composite_tick(void *node_handle)
 {
     Node *node = node_handle;
     CompositeNode *comp = node_handle;
+    int is_sequence = node->type == NT_SEQUENCE || node->type == NT_REACTIVE_SEQUENCE;
+    int is_reactive = node->type == NT_REACTIVE_SEQUENCE || node->type == NT_REACTIVE_FALLBACK;
 
     int i;
     for (i = 0; i < comp->child_count; i++)
@@ -105,100 +342,229 @@ extern int behaviour_node_internal_composite_tick(void *node_handle)
 
         if (child->state == NS_PENDING)
         {
+            if (is_reactive && i > 0)
+                behaviour_node_internal_start_observing((ReactiveNode *)node, i);
             behaviour_node_internal_move_focus(child);
             return 1;
         }
-        else if (child->state == NS_FAILED && node->type == NT_SEQUENCE)
+        else if (child->state == NS_FAILED && is_sequence)
         {
             node->state = NS_FAILED;
-            return 1;
+            break;
         }
-        else if (child->state == NS_SUCCEEDED && node->type == NT_FALLBACK)
+        else if (child->state == NS_SUCCEEDED && !is_sequence)
         {
             node->state = NS_SUCCEEDED;
-            return 1;
+            break;
         }
     }
-    behaviour_node_internal_move_focus(node->parent);
-    return node->type == NT_SEQUENCE;
+    if (i == comp->child_count)
+        node->state = is_sequence ? NS_SUCCEEDED : NS_FAILED;
+    if (is_reactive)
+        behaviour_node_internal_stop_observing((ReactiveNode *)node);
+    return 1;
 }
 
 /* -------------------------------------------------------------------------- */
 /*                      behaviour node internal functions                     */
 /* -------------------------------------------------------------------------- */
 
-extern int behaviour_node_internal_is_next_child(CompositeNode *node_handle)
+extern int behaviour_node_internal_get_child_count(Node *node_handle)
 {
-    return node_handle->current_child_index + 1 < node_handle->child_count;
+    switch (node_handle->type)
+    {
+    case NT_REPEATER:
+    case NT_INVERTER:
+    case NT_WAIT:
+    case NT_TIMEOUT:
+    case NT_COOLDOWN:
+        return ((DecoratorNode *)node_handle)->child != NULL;
+    case NT_SEQUENCE:
+    case NT_FALLBACK:
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
+        return ((CompositeNode *)node_handle)->child_count;
+    default:
+        return 0;
+    }
 }
 
-extern Node *behaviour_node_internal_get_next_child(CompositeNode *node_handle)
+extern Node *behaviour_node_internal_get_child(Node *node_handle, int index)
 {
-    ASSERT_MSG(node_handle->child_count == 0, "Can only retrieve children if children are assigned to composite node");
-    node_handle->current_child_index++;
-    return node_handle->children[node_handle->current_child_index];
+    switch (node_handle->type)
+    {
+    case NT_REPEATER:
+    case NT_INVERTER:
+    case NT_WAIT:
+    case NT_TIMEOUT:
+    case NT_COOLDOWN:
+        return ((DecoratorNode *)node_handle)->child;
+    case NT_SEQUENCE:
+    case NT_FALLBACK:
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
+        return ((CompositeNode *)node_handle)->children[index];
+    default:
+        return NULL;
+    }
 }
 
-extern int behaviour_node_internal_reset_child_index(CompositeNode *node_handle)
+extern NodeState behaviour_node_internal_get_state(Node *node_handle)
 {
-    node_handle->current_child_index = -1;
-    return 1;
+    return node_handle->state;
 }
 
-extern int behaviour_node_internal_recursive_dispatcher(Job job_handle, Node *node_handle, void *param_v_1, void *param_v_2)
+extern Node *behaviour_node_internal_get_parent(Node *node_handle)
+{
+    return node_handle->parent;
+}
+
+extern int behaviour_node_internal_set_error(BehaviourError *error_handle, BehaviourErrorCode code, Node *node_handle, const char *message)
 {
-    job_handle(node_handle, param_v_1, param_v_1);
+    error_handle->code = code;
+    error_handle->node = node_handle;
+    error_handle->message = message;
+    return 0;
+}
+
+extern int behaviour_node_internal_validate(Node *node_handle, int depth, void *context_handle)
+{
+    ValidationContext *context = context_handle;
+    int child_count = behaviour_node_internal_get_child_count(node_handle);
+    int i;
+
+    node_handle->finalized = 0;
     switch (node_handle->type)
     {
+    case NT_WAIT:
+    case NT_TIMEOUT:
+    case NT_COOLDOWN:
+        if (((TimerNode *)node_handle)->wheel == NULL)
+            return behaviour_node_internal_set_error(context->error, BE_MISSING_WHEEL, node_handle,
+                                                     "Timer node has no timing wheel");
+        if (child_count == 0)
+            return behaviour_node_internal_set_error(context->error, BE_DECORATOR_NO_CHILD, node_handle,
+                                                     "Decorator node has no child");
+        break;
     case NT_REPEATER:
+        if (((RepeaterNode *)node_handle)->starting_repetitions == 0)
+            return behaviour_node_internal_set_error(context->error, BE_UNSET_REPETITIONS, node_handle,
+                                                     "Repeater starting repetitions must be set (-1 to repeat forever)");
+        if (child_count == 0)
+            return behaviour_node_internal_set_error(context->error, BE_DECORATOR_NO_CHILD, node_handle,
+                                                     "Decorator node has no child");
+        break;
     case NT_INVERTER:
-        behaviour_node_internal_recursive_dispatcher(
-            job_handle,
-            ((DecoratorNode *)node_handle)->child,
-            param_v_1,
-            param_v_2);
-        return 1;
+        if (child_count == 0)
+            return behaviour_node_internal_set_error(context->error, BE_DECORATOR_NO_CHILD, node_handle,
+                                                     "Decorator node has no child");
+        break;
     case NT_SEQUENCE:
     case NT_FALLBACK:
-        while (behaviour_node_internal_is_next_child((CompositeNode *)node_handle))
-        {
-            behaviour_node_internal_recursive_dispatcher(
-                job_handle,
-                behaviour_node_internal_get_next_child((CompositeNode *)node_handle),
-                param_v_1,
-                param_v_2);
-        }
-        behaviour_node_internal_reset_child_index((CompositeNode *)node_handle);
-        return 1;
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
+        if ((node_handle->type == NT_REACTIVE_SEQUENCE || node_handle->type == NT_REACTIVE_FALLBACK) &&
+            ((ReactiveNode *)node_handle)->guard_rate == 0 && ((ReactiveNode *)node_handle)->guard_version == NULL)
+            return behaviour_node_internal_set_error(context->error, BE_GUARD_NEVER_CHECKED, node_handle,
+                                                     "Reactive node has a guard rate of 0 and no guard version");
+        if (child_count == 0)
+            return behaviour_node_internal_set_error(context->error, BE_EMPTY_COMPOSITE, node_handle,
+                                                     "Composite node has no children");
+        break;
     default:
-        return 1;
+        if (node_handle->tick == NULL)
+            return behaviour_node_internal_set_error(context->error, BE_MISSING_ACTION, node_handle,
+                                                     "Leaf node has no tick action");
+        break;
     }
-    return 0;
+
+    // children are checked before the walk descends into them, so a cycle is never followed.
+    for (i = 0; i < child_count; i++)
+    {
+        Node *child = behaviour_node_internal_get_child(node_handle, i);
+        if (child == NULL)
+            return behaviour_node_internal_set_error(context->error, BE_NULL_NODE, node_handle,
+                                                     "Composite node has a null child");
+        if (child == context->root)
+            return behaviour_node_internal_set_error(context->error, BE_CYCLE, node_handle,
+                                                     "Node's child is the tree root");
+        if (child->parent != node_handle)
+            return behaviour_node_internal_set_error(context->error, BE_SHARED_CHILD, child,
+                                                     "Node is the child of more than one node");
+    }
+    return 1;
 }
 
-extern NodeState behaviour_node_internal_get_state(Node *node_handle)
+extern int behaviour_node_internal_invalidate(Node *node_handle)
 {
-    return node_handle->state;
+    Node *ancestor;
+
+    // a finalized node's subtree is always finalized too, so stop at the first ancestor that already isn't.
+    for (ancestor = node_handle; ancestor != NULL && ancestor->finalized; ancestor = ancestor->parent)
+        ancestor->finalized = 0;
+    return 1;
 }
 
-extern Node *behaviour_node_internal_get_parent(Node *node_handle)
+extern int behaviour_node_internal_mark_finalized(Node *node_handle, int depth, void *a)
 {
-    return node_handle->parent;
+    int i;
+
+    // visited post order, so every child is already marked.
+    switch (node_handle->type)
+    {
+    case NT_LEAF:
+        node_handle->evaluable = 1;
+        break;
+    case NT_INVERTER:
+        node_handle->evaluable = ((DecoratorNode *)node_handle)->child->evaluable;
+        break;
+    case NT_SEQUENCE:
+    case NT_FALLBACK:
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
+        node_handle->evaluable = 1;
+        for (i = 0; i < ((CompositeNode *)node_handle)->child_count; i++)
+            node_handle->evaluable &= ((CompositeNode *)node_handle)->children[i]->evaluable;
+        break;
+    default:
+        node_handle->evaluable = 0;
+        break;
+    }
+    node_handle->finalized = 1;
+    return 1;
 }
 
-extern int behaviour_node_internal_reset_state(Node *node_handle, void *a1, void *a2)
+extern int behaviour_node_internal_reset_state(Node *node_handle, int depth, void *a)
 {
-    node_handle->state = NS_PENDING;
+    behaviour_node_internal_abort_state(node_handle, depth, a);
     node_handle->is_root_node = 0;
     node_handle->root = NULL;
     node_handle->currently_executing = NULL;
+    node_handle->parked = 0;
+    node_handle->observers = NULL;
+    return 1;
+}
+
+extern int behaviour_node_internal_abort_state(Node *node_handle, int depth, void *a)
+{
+    node_handle->state = NS_PENDING;
 
     if (node_handle->type == NT_REPEATER)
         ((RepeaterNode *)node_handle)->repetitions = ((RepeaterNode *)node_handle)->starting_repetitions;
+    else if (node_handle->type == NT_WAIT)
+    {
+        // the tree was parked on this wait, and has to be ticked again now that nothing will wake it.
+        if (behaviour_wheel_internal_cancel(&((TimerNode *)node_handle)->entry) && node_handle->root != NULL)
+            ((Node *)node_handle->root)->parked = 0;
+    }
+    else if (node_handle->type == NT_TIMEOUT)
+        behaviour_wheel_internal_cancel(&((TimerNode *)node_handle)->entry);
+    else if (node_handle->type == NT_REACTIVE_SEQUENCE || node_handle->type == NT_REACTIVE_FALLBACK)
+        behaviour_node_internal_stop_observing((ReactiveNode *)node_handle);
     return 1;
 }
 
-extern int behaviour_node_internal_set_root(Node *node_handle, void *root_node_handle, void *a2)
+extern int behaviour_node_internal_set_root(Node *node_handle, int depth, void *root_node_handle)
 {
     node_handle->root = root_node_handle;
     return 1;
@@ -210,8 +576,8 @@ extern int behaviour_node_internal_set_root(Node *node_handle, void *root_node_h
 
 extern int behaviour_node_external_run(Node *node_handle)
 {
+    // the node stays in focus and is ticked again next tick. Ticking it from here would recurse forever.
     node_handle->state = NS_UNDETERMINED;
-    node_handle->tick(node_handle);
     return 1;
 }
 
@@ -236,30 +602,84 @@ extern Node *behaviour_node_create(NodeType type)
     if (type == NT_LEAF)
     {
         return_node = malloc(sizeof(LeafNode));
+        ASSERT_MSG(return_node == NULL, "Node memory allocation failed");
+        ((LeafNode *)return_node)->configured_start = NULL;
+        ((LeafNode *)return_node)->configured_stop = NULL;
+        ((LeafNode *)return_node)->subject = NULL;
+        ((LeafNode *)return_node)->blackboard = NULL;
+        return_node->tick = NULL;
     }
     else if (type == NT_INVERTER || type == NT_REPEATER)
     {
         if (type == NT_REPEATER)
         {
             return_node = malloc(sizeof(RepeaterNode));
+            ASSERT_MSG(return_node == NULL, "Node memory allocation failed");
             ((RepeaterNode *)return_node)->starting_repetitions = 0;
             ((RepeaterNode *)return_node)->repetitions = 0;
         }
         else
+        {
             return_node = malloc(sizeof(DecoratorNode));
+            ASSERT_MSG(return_node == NULL, "Node memory allocation failed");
+        }
+        ((DecoratorNode *)return_node)->child = NULL;
         return_node->tick = behaviour_node_internal_decorator_tick;
     }
+    else if (type == NT_WAIT || type == NT_TIMEOUT || type == NT_COOLDOWN)
+    {
+        TimerNode *timer = malloc(sizeof(TimerNode));
+        ASSERT_MSG(timer == NULL, "Node memory allocation failed");
+        timer->child = NULL;
+        timer->wheel = NULL;
+        timer->duration = 0;
+        timer->ready_at = 0;
+        timer->entry.next = NULL;
+        timer->entry.prev = NULL;
+        timer->entry.deadline = 0;
+        timer->entry.node = (Node *)timer;
+        return_node = (Node *)timer;
+        return_node->tick = behaviour_node_internal_timer_tick;
+    }
     else
     {
-        return_node = malloc(sizeof(CompositeNode));
+        if (type == NT_REACTIVE_SEQUENCE || type == NT_REACTIVE_FALLBACK)
+        {
+            ReactiveNode *reactive = malloc(sizeof(ReactiveNode));
+            ASSERT_MSG(reactive == NULL, "Node memory allocation failed");
+            reactive->running_child = 0;
+            reactive->guard_rate = 1;
+            reactive->ticks_until_check = 1;
+            reactive->guard_version = NULL;
+            reactive->seen_version = 0;
+            reactive->observing = 0;
+            reactive->next_observer = NULL;
+            return_node = (Node *)reactive;
+        }
+        else
+        {
+            return_node = malloc(sizeof(CompositeNode));
+            ASSERT_MSG(return_node == NULL, "Node memory allocation failed");
+        }
         ((CompositeNode *)return_node)->child_count = 0;
-        ((CompositeNode *)return_node)->current_child_index = -1;
+        ((CompositeNode *)return_node)->children = NULL;
         return_node->tick = behaviour_node_internal_composite_tick;
     }
     return_node->type = type;
+    return_node->parent = NULL;
+    return_node->root = NULL;
+    return_node->currently_executing = NULL;
+    return_node->label = NULL;
+    return_node->finalized = 0;
+    return_node->evaluable = 0;
+    return_node->parked = 0;
+    return_node->observers = NULL;
     return_node->is_root_node = 0;
     return_node->state = NS_PENDING;
-    return_node->start = behaviour_node_internal_standard_start;
+    if (type == NT_WAIT || type == NT_TIMEOUT || type == NT_COOLDOWN)
+        return_node->start = behaviour_node_internal_timer_start;
+    else
+        return_node->start = behaviour_node_internal_standard_start;
     return return_node;
 }
 
@@ -267,7 +687,13 @@ extern int behaviour_node_add_child(Node *parent_node_handle, Node *child_node_h
 {
     ASSERT_MSG(parent_node_handle->type == NT_LEAF, "Cannot add a child to a leaf node");
 
-    if (parent_node_handle->type == NT_REPEATER || parent_node_handle->type == NT_INVERTER)
+    // the child's old tree now shares it, so it has to be validated again too.
+    if (child_node_handle->parent != NULL)
+        behaviour_node_internal_invalidate(child_node_handle->parent);
+
+    if (parent_node_handle->type == NT_REPEATER || parent_node_handle->type == NT_INVERTER ||
+        parent_node_handle->type == NT_WAIT || parent_node_handle->type == NT_TIMEOUT ||
+        parent_node_handle->type == NT_COOLDOWN)
     {
         ASSERT_MSG(((DecoratorNode *)parent_node_handle)->child != NULL, "Decorator nodes cannot have > 1 child");
         ((DecoratorNode *)parent_node_handle)->child = child_node_handle;
@@ -278,15 +704,16 @@ extern int behaviour_node_add_child(Node *parent_node_handle, Node *child_node_h
         if (composite->child_count % COMPOSITE_NODE_ARRAY_BUFFER_INCREMENT == 0)
         {
             Node **temp = realloc(composite->children,
-                                  composite->child_count + COMPOSITE_NODE_ARRAY_BUFFER_INCREMENT);
+                                  (sizeof *temp) * (composite->child_count + COMPOSITE_NODE_ARRAY_BUFFER_INCREMENT));
             ASSERT_MSG(temp == NULL, "Composite node memory allocation failed");
-            free(composite->children);
             composite->children = temp;
         }
         composite->child_count++;
         composite->children[composite->child_count - 1] = child_node_handle;
     }
     child_node_handle->parent = parent_node_handle;
+
+    behaviour_node_internal_invalidate(parent_node_handle);
     return 1;
 }
 
@@ -301,6 +728,7 @@ extern int behaviour_node_set_action(Node *node_handle, Action tick_action_handl
 {
     ASSERT_MSG(node_handle->type != NT_LEAF, "Only leaf nodes can have tick actions configured");
     node_handle->tick = tick_action_handle;
+    behaviour_node_internal_invalidate(node_handle);
     return 1;
 }
 
@@ -330,30 +758,74 @@ extern int behaviour_node_set_subject(Node *node_handle, void *subject_handle)
 
 extern void * behaviour_node_get_subject(Node *node_handle)
 {
-    ASSERT_MSG(node_handle->type != NT_LEAF, "Non-leaf nodes have no subject");
-    ASSERT_MSG(((LeafNode *)node_handle)->subject == NULL, "Node subject is null");
+    CHECK_MSG(node_handle->type != NT_LEAF, "Non-leaf nodes have no subject");
+    CHECK_MSG(((LeafNode *)node_handle)->subject == NULL, "Node subject is null");
     return ((LeafNode *)node_handle)->subject;
 }
 
 extern void * behaviour_node_get_blackboard(Node *node_handle)
 {
-    ASSERT_MSG(node_handle->type != NT_LEAF, "Non-leaf nodes have no blackboard");
-    ASSERT_MSG(((LeafNode *)node_handle)->blackboard == NULL, "Node blackboard is null");
+    CHECK_MSG(node_handle->type != NT_LEAF, "Non-leaf nodes have no blackboard");
+    CHECK_MSG(((LeafNode *)node_handle)->blackboard == NULL, "Node blackboard is null");
     return ((LeafNode *)node_handle)->blackboard;
 }
 
 
+extern int behaviour_node_get_child_count(Node *node_handle)
+{
+    return behaviour_node_internal_get_child_count(node_handle);
+}
+
+extern Node * behaviour_node_get_child(Node *node_handle, int index)
+{
+    ASSERT_MSG(index < 0 || index >= behaviour_node_internal_get_child_count(node_handle), "Child index out of range");
+    return behaviour_node_internal_get_child(node_handle, index);
+}
+
 extern int behaviour_node_set_repetitions(Node *node_handle, int repetitions)
 {
     ASSERT_MSG(node_handle->type != NT_REPEATER, "Only repeater nodes can have repetitions configured");
     ((RepeaterNode *)node_handle)->repetitions = repetitions;
     ((RepeaterNode *)node_handle)->starting_repetitions = repetitions;
+    behaviour_node_internal_invalidate(node_handle);
+    return 1;
+}
+
+extern int behaviour_node_set_timer(Node *node_handle, TimingWheel *wheel_handle, unsigned long duration)
+{
+    ASSERT_MSG(node_handle->type != NT_WAIT && node_handle->type != NT_TIMEOUT && node_handle->type != NT_COOLDOWN,
+               "Only wait, timeout and cooldown nodes can have a timer configured");
+    ((TimerNode *)node_handle)->wheel = wheel_handle;
+    ((TimerNode *)node_handle)->duration = duration;
+    behaviour_node_internal_invalidate(node_handle);
+    return 1;
+}
+
+extern int behaviour_node_set_guard_rate(Node *node_handle, int guard_rate)
+{
+    ASSERT_MSG(node_handle->type != NT_REACTIVE_SEQUENCE && node_handle->type != NT_REACTIVE_FALLBACK,
+               "Only reactive nodes can have a guard rate configured");
+    ASSERT_MSG(guard_rate < 0, "Guard rate must be >= 0");
+    ((ReactiveNode *)node_handle)->guard_rate = guard_rate;
+    ((ReactiveNode *)node_handle)->ticks_until_check = guard_rate;
+    behaviour_node_internal_invalidate(node_handle);
+    return 1;
+}
+
+extern int behaviour_node_set_guard_version(Node *node_handle, unsigned long *version_handle)
+{
+    ASSERT_MSG(node_handle->type != NT_REACTIVE_SEQUENCE && node_handle->type != NT_REACTIVE_FALLBACK,
+               "Only reactive nodes can have a guard version configured");
+    ((ReactiveNode *)node_handle)->guard_version = version_handle;
+    if (version_handle != NULL)
+        ((ReactiveNode *)node_handle)->seen_version = *version_handle;
+    behaviour_node_internal_invalidate(node_handle);
     return 1;
 }
 
 extern int behaviour_node_get_information(Node *node_handle)
 {
-    printf("Type: %s\nParent: %p\nRoot: %p\nCurrently executing: %p\nIs root: %d\nState: %d\nStart: %p\nTick: %p\nLabel: %s\n",
+    printf("Type: %s\nParent: %p\nRoot: %p\nCurrently executing: %p\nIs root: %d\nState: %d\nStart: %p\nTick: %p\nLabel: %s\nFinalized: %d\n",
            TYPE_LABELS[node_handle->type],
            node_handle->parent,
            node_handle->root,
@@ -362,7 +834,8 @@ extern int behaviour_node_get_information(Node *node_handle)
            node_handle->state,
            node_handle->start,
            node_handle->tick,
-           node_handle->label ? node_handle->label : "n/a");
+           node_handle->label ? node_handle->label : "n/a",
+           node_handle->finalized);
 
     switch (node_handle->type)
     {
@@ -382,11 +855,29 @@ extern int behaviour_node_get_information(Node *node_handle)
         printf("Child: %p\n\n",
                ((DecoratorNode *)node_handle)->child);
         return 1;
+    case NT_WAIT:
+    case NT_TIMEOUT:
+    case NT_COOLDOWN:
+        printf("Wheel: %p\nDuration: %lu\nReady at: %lu\nScheduled: %d\nChild: %p\n\n",
+               ((TimerNode *)node_handle)->wheel,
+               ((TimerNode *)node_handle)->duration,
+               ((TimerNode *)node_handle)->ready_at,
+               ((TimerNode *)node_handle)->entry.next != NULL,
+               ((TimerNode *)node_handle)->child);
+        return 1;
     case NT_FALLBACK:
     case NT_SEQUENCE:
-        printf("Child_count: %d\nCurrent_index: %d\n\n",
-               ((CompositeNode *)node_handle)->child_count,
-               ((CompositeNode *)node_handle)->current_child_index);
+        printf("Child_count: %d\n\n",
+               ((CompositeNode *)node_handle)->child_count);
+        return 1;
+    case NT_REACTIVE_SEQUENCE:
+    case NT_REACTIVE_FALLBACK:
+        printf("Child_count: %d\nRunning child: %d\nGuard rate: %d\nGuard version: %p\nObserving: %d\n\n",
+               ((ReactiveNode *)node_handle)->child_count,
+               ((ReactiveNode *)node_handle)->running_child,
+               ((ReactiveNode *)node_handle)->guard_rate,
+               ((ReactiveNode *)node_handle)->guard_version,
+               ((ReactiveNode *)node_handle)->observing);
         return 1;
     default:
         printf("\n");
@@ -398,21 +889,112 @@ extern int behaviour_node_get_information(Node *node_handle)
 /*                      behaviour tree external functions                     */
 /* -------------------------------------------------------------------------- */
 
+extern int behaviour_tree_finalize(Node *root_node_handle, BehaviourError *error_handle)
+{
+    BehaviourError error = {BE_NONE, NULL, NULL};
+
+    if (root_node_handle == NULL)
+    {
+        error.code = BE_NULL_NODE;
+        error.message = "Cannot finalize a null tree";
+    }
+    else
+    {
+        ValidationContext context = {root_node_handle, &error};
+        if (behaviour_tree_visit(root_node_handle, TO_PRE_ORDER, -1, behaviour_node_internal_validate, &context))
+            behaviour_tree_visit(root_node_handle, TO_POST_ORDER, -1, behaviour_node_internal_mark_finalized, NULL);
+    }
+
+    if (error_handle != NULL)
+        *error_handle = error;
+    return error.code == BE_NONE;
+}
+
 extern int behaviour_tree_reset(Node *root_node_handle)
 {
-    behaviour_node_internal_recursive_dispatcher(
-        behaviour_node_internal_reset_state,
-        root_node_handle,
-        NULL,
-        NULL);
+    behaviour_tree_visit(root_node_handle, TO_PRE_ORDER, -1, behaviour_node_internal_reset_state, NULL);
     return 1;
 }
 
+extern int behaviour_tree_visit(Node *root_node_handle, TraversalOrder order, int max_depth, Visitor visitor_handle, void *user_data)
+{
+    int stack_size = TRAVERSAL_STACK_BUFFER_INCREMENT;
+    int top = 0;
+    int completed = 1;
+    TraversalFrame local_stack[TRAVERSAL_STACK_BUFFER_INCREMENT];
+    TraversalFrame *stack = local_stack;
+
+    ASSERT_MSG(root_node_handle == NULL, "Cannot visit a null tree");
+    ASSERT_MSG(visitor_handle == NULL, "Cannot visit a tree without a visitor function");
+
+    if (order == TO_PRE_ORDER && !visitor_handle(root_node_handle, 0, user_data))
+        return 0;
+    stack[0] = (TraversalFrame){root_node_handle, 0, 0};
+
+    while (top >= 0)
+    {
+        TraversalFrame *frame = &stack[top];
+        if (frame->next_child < behaviour_node_internal_get_child_count(frame->node) &&
+            (max_depth < 0 || frame->depth < max_depth))
+        {
+            Node *child = behaviour_node_internal_get_child(frame->node, frame->next_child);
+            int depth = frame->depth + 1;
+            frame->next_child++;
+            if (child == NULL)
+                continue;
+
+            if (order == TO_PRE_ORDER && !visitor_handle(child, depth, user_data))
+            {
+                completed = 0;
+                break;
+            }
+            if (top + 1 == stack_size)
+            {
+                // only walks deeper than the on-stack frames touch the heap.
+                TraversalFrame *temp;
+                if (stack == local_stack)
+                {
+                    temp = malloc((sizeof *stack) * (stack_size + TRAVERSAL_STACK_BUFFER_INCREMENT));
+                    ASSERT_MSG(temp == NULL, "Traversal stack memory allocation failed");
+                    memcpy(temp, local_stack, (sizeof *stack) * stack_size);
+                }
+                else
+                {
+                    temp = realloc(stack, (sizeof *stack) * (stack_size + TRAVERSAL_STACK_BUFFER_INCREMENT));
+                    ASSERT_MSG(temp == NULL, "Traversal stack memory allocation failed");
+                }
+                stack = temp;
+                stack_size += TRAVERSAL_STACK_BUFFER_INCREMENT;
+            }
+            top++;
+            stack[top] = (TraversalFrame){child, 0, depth};
+        }
+        else
+        {
+            if (order == TO_POST_ORDER && !visitor_handle(frame->node, frame->depth, user_data))
+            {
+                completed = 0;
+                break;
+            }
+            top--;
+        }
+    }
+    if (stack != local_stack)
+        free(stack);
+    return completed;
+}
+
 extern int behaviour_tree_tick(Node *root_node_handle)
 {
     if (root_node_handle->state == NS_UNDETERMINED)
     {
-        Node *focus = root_node_handle->currently_executing;
+        Node *focus;
+
+        // a guard that changed its mind moves focus itself, which uses up this tick.
+        if (root_node_handle->observers != NULL && behaviour_node_internal_check_observers(root_node_handle))
+            return behaviour_tree_get_state(root_node_handle);
+
+        focus = root_node_handle->currently_executing;
 
         switch (focus->state)
         {
@@ -442,12 +1024,14 @@ extern int behaviour_tree_tick(Node *root_node_handle)
     }
     else if (root_node_handle->state == NS_PENDING)
     {
+        // an invalid tree just fails. Call behaviour_tree_finalize up front to find out why.
+        if (!root_node_handle->finalized && !behaviour_tree_finalize(root_node_handle, NULL))
+        {
+            root_node_handle->state = NS_FAILED;
+            return behaviour_tree_get_state(root_node_handle);
+        }
         behaviour_tree_reset(root_node_handle);
-        behaviour_node_internal_recursive_dispatcher(
-            behaviour_node_internal_set_root,
-            root_node_handle,
-            root_node_handle,
-            NULL);
+        behaviour_tree_visit(root_node_handle, TO_PRE_ORDER, -1, behaviour_node_internal_set_root, root_node_handle);
         root_node_handle->is_root_node = 1;
         root_node_handle->start(root_node_handle);
         behaviour_node_internal_move_focus(root_node_handle);
@@ -467,7 +1051,8 @@ extern int behaviour_tree_get_state(Node *root_node_handle)
 
 extern int behaviour_tree_run(Node *root_node_handle)
 {
-    while (behaviour_tree_get_state(root_node_handle) == -1)
+    // nothing advances the timing wheel in here, so a tree that parks on a wait can't finish. Give up and report -1.
+    while (behaviour_tree_get_state(root_node_handle) == -1 && !behaviour_tree_is_parked(root_node_handle))
     {
         behaviour_tree_tick(root_node_handle);
     }
@@ -476,9 +1061,322 @@ extern int behaviour_tree_run(Node *root_node_handle)
     return evaluation;
 }
 
+extern int behaviour_tree_is_parked(Node *root_node_handle)
+{
+    return root_node_handle->parked;
+}
+
 extern int behaviour_node_set_blackboard(Node *node_handle, void *blackboard_handle)
 {
     ASSERT_MSG(node_handle->type != NT_LEAF, "Only leaf nodes can have a blackboard assigned!");
     ((LeafNode *)node_handle)->blackboard = blackboard_handle;
     return 1;
-}
\ No newline at end of file
+}
+
+/* -------------------------------------------------------------------------- */
+/*                       behaviour wheel internal functions                   */
+/* -------------------------------------------------------------------------- */
+
+extern int behaviour_wheel_internal_schedule(TimingWheel *wheel_handle, TimerEntry *entry_handle, unsigned long deadline)
+{
+    unsigned long expires = deadline;
+    long delta = (long)(deadline - wheel_handle->current);
+    TimerEntry *slot;
+    int level = 0;
+
+    behaviour_wheel_internal_cancel(entry_handle);
+    entry_handle->deadline = deadline;
+
+    if (delta < 0)
+    {
+        // already due, expire on the next time unit processed.
+        slot = &wheel_handle->slots[0][wheel_handle->current & WHEEL_SLOT_MASK];
+    }
+    else
+    {
+        if ((unsigned long)delta >= WHEEL_RANGE)
+        {
+            delta = WHEEL_RANGE - 1;
+            expires = wheel_handle->current + delta;
+        }
+        while ((unsigned long)delta >= (1UL << (WHEEL_SLOT_BITS * (level + 1))))
+            level++;
+        slot = &wheel_handle->slots[level][(expires >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK];
+    }
+
+    entry_handle->next = slot;
+    entry_handle->prev = slot->prev;
+    slot->prev->next = entry_handle;
+    slot->prev = entry_handle;
+    return 1;
+}
+
+extern int behaviour_wheel_internal_cancel(TimerEntry *entry_handle)
+{
+    if (entry_handle->next == NULL)
+        return 0;
+    entry_handle->prev->next = entry_handle->next;
+    entry_handle->next->prev = entry_handle->prev;
+    entry_handle->next = NULL;
+    entry_handle->prev = NULL;
+    return 1;
+}
+
+extern int behaviour_wheel_internal_cascade(TimingWheel *wheel_handle, int level)
+{
+    int index = (wheel_handle->current >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    TimerEntry *slot = &wheel_handle->slots[level][index];
+
+    while (slot->next != slot)
+        behaviour_wheel_internal_schedule(wheel_handle, slot->next, slot->next->deadline);
+    return index;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                       behaviour wheel external functions                   */
+/* -------------------------------------------------------------------------- */
+
+extern TimingWheel *behaviour_wheel_create(unsigned long now)
+{
+    int level, index;
+    TimingWheel *wheel = malloc(sizeof(TimingWheel));
+    ASSERT_MSG(wheel == NULL, "Timing wheel memory allocation failed");
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (index = 0; index < WHEEL_SLOTS; index++)
+        {
+            wheel->slots[level][index].next = &wheel->slots[level][index];
+            wheel->slots[level][index].prev = &wheel->slots[level][index];
+            wheel->slots[level][index].node = NULL;
+        }
+    }
+    wheel->now = now;
+    wheel->current = now + 1;
+    wheel->wake = NULL;
+    wheel->wake_data = NULL;
+    wheel->woken = 0;
+    return wheel;
+}
+
+extern int behaviour_wheel_advance(TimingWheel *wheel_handle, unsigned long now, Wake wake_handle, void *user_data)
+{
+    ASSERT_MSG(now < wheel_handle->now, "Timing wheel cannot be advanced backwards");
+
+    wheel_handle->wake = wake_handle;
+    wheel_handle->wake_data = user_data;
+    wheel_handle->woken = 0;
+
+    while (wheel_handle->current <= now)
+    {
+        int index = wheel_handle->current & WHEEL_SLOT_MASK;
+        TimerEntry *slot = &wheel_handle->slots[0][index];
+        int level;
+
+        // when the finest level wraps, pull the next slot of each coarser level down, stopping at the first that doesn't wrap.
+        if (index == 0)
+        {
+            for (level = 1; level < WHEEL_LEVELS; level++)
+            {
+                if (behaviour_wheel_internal_cascade(wheel_handle, level) != 0)
+                    break;
+            }
+        }
+        wheel_handle->now = wheel_handle->current;
+        wheel_handle->current++;
+
+        while (slot->next != slot)
+        {
+            TimerEntry *entry = slot->next;
+            behaviour_wheel_internal_cancel(entry);
+            if (entry->deadline > wheel_handle->now)
+                behaviour_wheel_internal_schedule(wheel_handle, entry, entry->deadline);
+            else
+                behaviour_node_internal_timer_expire(entry->node);
+        }
+    }
+    wheel_handle->now = now;
+    wheel_handle->wake = NULL;
+    wheel_handle->wake_data = NULL;
+    return wheel_handle->woken;
+}
+
+extern unsigned long behaviour_wheel_get_time(TimingWheel *wheel_handle)
+{
+    return wheel_handle->now;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                    behaviour blackboard internal functions                 */
+/* -------------------------------------------------------------------------- */
+
+// the writer each thread's leaves write through, see behaviour_blackboard_bind_writer.
+static _Thread_local BlackboardWriter *bound_writer = NULL;
+
+extern int behaviour_blackboard_internal_apply(Blackboard *blackboard_handle, BlackboardWrite *write_handle)
+{
+    int slot = write_handle->slot;
+
+    switch (blackboard_handle->policy)
+    {
+    case BC_FIRST_WRITE_WINS:
+        if (blackboard_handle->written[slot] == blackboard_handle->generation)
+            return 0;
+        blackboard_handle->back[slot] = write_handle->value;
+        break;
+    case BC_MERGE:
+        blackboard_handle->back[slot] = blackboard_handle->merge(blackboard_handle->back[slot], write_handle->value);
+        break;
+    default:
+        blackboard_handle->back[slot] = write_handle->value;
+        break;
+    }
+    blackboard_handle->written[slot] = blackboard_handle->generation;
+    return 1;
+}
+
+extern int behaviour_blackboard_internal_compare_writes(const void *a, const void *b)
+{
+    const BlackboardWrite *left = a;
+    const BlackboardWrite *right = b;
+
+    if (left->slot != right->slot)
+        return (left->slot < right->slot) ? -1 : 1;
+    if (left->key != right->key)
+        return (left->key < right->key) ? -1 : 1;
+    if (left->sequence != right->sequence)
+        return (left->sequence < right->sequence) ? -1 : 1;
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                    behaviour blackboard external functions                 */
+/* -------------------------------------------------------------------------- */
+
+extern Blackboard *behaviour_blackboard_create(int slot_count, BlackboardConflict policy, Merge merge_handle)
+{
+    Blackboard *blackboard;
+
+    ASSERT_MSG(slot_count <= 0, "Blackboard must have at least 1 slot");
+    ASSERT_MSG(policy < 0 || policy >= BC_COUNT, "Cannot create blackboard with an unknown conflict policy");
+    ASSERT_MSG(policy == BC_MERGE && merge_handle == NULL, "Blackboards using BC_MERGE need a merge function");
+
+    blackboard = malloc(sizeof(Blackboard));
+    ASSERT_MSG(blackboard == NULL, "Blackboard memory allocation failed");
+    blackboard->front = calloc(slot_count, sizeof(BlackboardValue));
+    blackboard->back = calloc(slot_count, sizeof(BlackboardValue));
+    blackboard->written = calloc(slot_count, sizeof(unsigned int));
+    ASSERT_MSG(blackboard->front == NULL || blackboard->back == NULL || blackboard->written == NULL,
+               "Blackboard memory allocation failed");
+
+    blackboard->slot_count = slot_count;
+    blackboard->policy = policy;
+    blackboard->merge = merge_handle;
+    blackboard->generation = 1;
+    blackboard->writer_count = 0;
+    blackboard->writer_capacity = 0;
+    blackboard->writers = NULL;
+    blackboard->pending_capacity = 0;
+    blackboard->pending = NULL;
+    return blackboard;
+}
+
+extern BlackboardWriter *behaviour_blackboard_create_writer(Blackboard *blackboard_handle)
+{
+    BlackboardWriter *writer = malloc(sizeof(BlackboardWriter));
+    ASSERT_MSG(writer == NULL, "Blackboard writer memory allocation failed");
+    writer->blackboard = blackboard_handle;
+    writer->write_count = 0;
+    writer->write_capacity = 0;
+    writer->writes = NULL;
+
+    if (blackboard_handle->writer_count == blackboard_handle->writer_capacity)
+    {
+        BlackboardWriter **temp = realloc(blackboard_handle->writers,
+                                          (sizeof *temp) * (blackboard_handle->writer_capacity + BLACKBOARD_BUFFER_INCREMENT));
+        ASSERT_MSG(temp == NULL, "Blackboard writer memory allocation failed");
+        blackboard_handle->writers = temp;
+        blackboard_handle->writer_capacity += BLACKBOARD_BUFFER_INCREMENT;
+    }
+    blackboard_handle->writers[blackboard_handle->writer_count++] = writer;
+    return writer;
+}
+
+extern BlackboardValue behaviour_blackboard_read(Blackboard *blackboard_handle, int slot)
+{
+    CHECK_MSG(slot < 0 || slot >= blackboard_handle->slot_count, "Blackboard slot out of range");
+    return blackboard_handle->front[slot];
+}
+
+extern int behaviour_blackboard_write(BlackboardWriter *writer_handle, unsigned long key, int slot, BlackboardValue value)
+{
+    CHECK_MSG(writer_handle == NULL, "Cannot write to a blackboard without a writer");
+    CHECK_MSG(slot < 0 || slot >= writer_handle->blackboard->slot_count, "Blackboard slot out of range");
+
+    if (writer_handle->write_count == writer_handle->write_capacity)
+    {
+        BlackboardWrite *temp = realloc(writer_handle->writes,
+                                        (sizeof *temp) * (writer_handle->write_capacity + BLACKBOARD_BUFFER_INCREMENT));
+        ASSERT_MSG(temp == NULL, "Blackboard write buffer memory allocation failed");
+        writer_handle->writes = temp;
+        writer_handle->write_capacity += BLACKBOARD_BUFFER_INCREMENT;
+    }
+    writer_handle->writes[writer_handle->write_count].slot = slot;
+    writer_handle->writes[writer_handle->write_count].key = key;
+    writer_handle->writes[writer_handle->write_count].sequence = writer_handle->write_count;
+    writer_handle->writes[writer_handle->write_count].value = value;
+    writer_handle->write_count++;
+    return 1;
+}
+
+extern int behaviour_blackboard_swap(Blackboard *blackboard_handle)
+{
+    BlackboardValue *temp;
+    int pending_count = 0;
+    int applied = 0;
+    int i;
+
+    for (i = 0; i < blackboard_handle->writer_count; i++)
+        pending_count += blackboard_handle->writers[i]->write_count;
+    if (pending_count > blackboard_handle->pending_capacity)
+    {
+        int capacity = pending_count + BLACKBOARD_BUFFER_INCREMENT - pending_count % BLACKBOARD_BUFFER_INCREMENT;
+        BlackboardWrite *pending = realloc(blackboard_handle->pending, (sizeof *pending) * capacity);
+        ASSERT_MSG(pending == NULL, "Blackboard write buffer memory allocation failed");
+        blackboard_handle->pending = pending;
+        blackboard_handle->pending_capacity = capacity;
+    }
+
+    // gathered and sorted so the result doesn't depend on which thread, and so which writer, a write came through.
+    pending_count = 0;
+    for (i = 0; i < blackboard_handle->writer_count; i++)
+    {
+        BlackboardWriter *writer = blackboard_handle->writers[i];
+        memcpy(blackboard_handle->pending + pending_count, writer->writes, (sizeof *writer->writes) * writer->write_count);
+        pending_count += writer->write_count;
+        writer->write_count = 0;
+    }
+    qsort(blackboard_handle->pending, pending_count, sizeof *blackboard_handle->pending,
+          behaviour_blackboard_internal_compare_writes);
+
+    memcpy(blackboard_handle->back, blackboard_handle->front, (sizeof *temp) * blackboard_handle->slot_count);
+    for (i = 0; i < pending_count; i++)
+        applied += behaviour_blackboard_internal_apply(blackboard_handle, &blackboard_handle->pending[i]);
+
+    temp = blackboard_handle->front;
+    blackboard_handle->front = blackboard_handle->back;
+    blackboard_handle->back = temp;
+    blackboard_handle->generation++;
+    return applied;
+}
+
+extern int behaviour_blackboard_bind_writer(BlackboardWriter *writer_handle)
+{
+    bound_writer = writer_handle;
+    return 1;
+}
+
+extern BlackboardWriter *behaviour_blackboard_get_writer(void)
+{
+    return bound_writer;
+}
@@ -6,14 +6,42 @@
     */
 #define COMPOSITE_NODE_ARRAY_BUFFER_INCREMENT 4
 
+/*
+    The explicit stack used by behaviour_tree_visit starts as 32 frames on the C stack, so most walks never touch the heap.
+        Deeper walks move it to the heap and grow it in blocks of 32 frames.
+    */
+#define TRAVERSAL_STACK_BUFFER_INCREMENT 32
+
+/*
+    Shape of the hierarchical timing wheel: WHEEL_LEVELS wheels of 2^WHEEL_SLOT_BITS slots each.
+        Level 0 slots are one time unit wide, each level above is WHEEL_SLOTS times coarser, so
+        4 levels of 64 slots cover 2^24 time units before a timer has to be re-scheduled on expiry.
+    */
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_RANGE (1UL << (WHEEL_SLOT_BITS * WHEEL_LEVELS))
+
+/*
+    Blackboard writers and their deferred write buffers grow in blocks of 16, to reduce calls to realloc.
+    */
+#define BLACKBOARD_BUFFER_INCREMENT 16
+
 /*
     Action: Function pointer for node actions.
         Tick, start and stop are examples of this.
     
-    Job: Function pointer for a recursive job.
-        These are used with the internal_recursive_job_dispatcher. The job function is called
-        on a node and all of its children. Currently used with reset and set root.
-        Massively simplifies and DRY's the code involved.
+    Visitor: Function pointer for a tree visitor.
+        These are used with behaviour_tree_visit. The visitor is called on a node and all of its
+        children along with the node's depth below the visit root. Returning 0 stops the walk early.
+        Currently used with reset, set root and finalize.
+
+    Wake: Function pointer called by behaviour_wheel_advance for every parked tree a timer wakes up,
+        so the caller can start ticking it again.
+
+    Merge: Function pointer combining a blackboard slot's current value with an incoming write, for
+        blackboards using BC_MERGE. Called once per write, in (slot, key, sequence) order, at the frame end swap.
      */
 typedef int (*Action)(void *node_handle);
 
@@ -28,6 +56,11 @@ typedef enum
     NT_SEQUENCE,
     NT_REPEATER,
     NT_INVERTER,
+    NT_WAIT,
+    NT_TIMEOUT,
+    NT_COOLDOWN,
+    NT_REACTIVE_SEQUENCE,
+    NT_REACTIVE_FALLBACK,
     NT_COUNT
 } NodeType;
 
@@ -43,6 +76,65 @@ typedef enum
     NS_UNDETERMINED
 } NodeState;
 
+/*
+    Enumeration of how a blackboard resolves several writes to one slot in the same frame.
+        Writes are applied in slot, then key, then the order they were made, whichever writer they went through.
+        BC_LAST_WRITE_WINS- the last write applied is kept.
+        BC_FIRST_WRITE_WINS- the first write applied is kept, later ones are dropped.
+        BC_MERGE- every write is folded into the slot's previous value with the blackboard's merge function.
+    */
+typedef enum
+{
+    BC_LAST_WRITE_WINS = 0,
+    BC_FIRST_WRITE_WINS,
+    BC_MERGE,
+    BC_COUNT
+} BlackboardConflict;
+
+/*
+    A value held in a blackboard slot. What each slot holds is up to the caller.
+    */
+typedef union
+{
+    long integer;
+    double real;
+    void *pointer;
+} BlackboardValue;
+
+/*
+    Enumeration of the orders behaviour_tree_visit can walk a tree in.
+        TO_PRE_ORDER- a node is visited before its children.
+        TO_POST_ORDER- a node is visited after all of its children.
+    */
+typedef enum
+{
+    TO_PRE_ORDER = 0,
+    TO_POST_ORDER
+} TraversalOrder;
+
+/*
+    Enumeration of the errors behaviour_tree_finalize can report.
+        BE_CYCLE- the walk came back around to the node it started at.
+        BE_SHARED_CHILD- a child is reachable from a node that isn't its parent, i.e it was added twice.
+        BE_UNSET_REPETITIONS- a repeater with 0 repetitions (use -1 to repeat forever).
+        BE_MISSING_WHEEL- a wait, timeout or cooldown node with no timing wheel to read time from.
+        BE_GUARD_NEVER_CHECKED- a reactive node with a guard rate of 0 and no guard version, so it never re-checks.
+    */
+typedef enum
+{
+    BE_NONE = 0,
+    BE_NULL_NODE,
+    BE_CYCLE,
+    BE_SHARED_CHILD,
+    BE_MISSING_ACTION,
+    BE_EMPTY_COMPOSITE,
+    BE_DECORATOR_NO_CHILD,
+    BE_UNSET_REPETITIONS,
+    BE_MISSING_WHEEL,
+    BE_GUARD_NEVER_CHECKED,
+    BE_COUNT
+} BehaviourErrorCode;
+
 /* 
     Structure for the head of a node. Essentially the base class of all nodes.
     All other nodes include this header as a commonality that they can be casted as.
@@ -57,6 +149,13 @@ typedef enum
         start- function pointer to the main start function of this node.
         tick- function pointer to the tick action of this node.
         label- a label used for printing out node information and eventually logging.
+        finalized- set by behaviour_tree_finalize once this node and its subtree have been validated.
+            Cleared again by any change finalize would have to re-check, anywhere beneath it.
+        evaluable- set by finalize when the subtree is only leaves, inverters and composites, so it can be
+            evaluated in one go and act as a reactive node's guard.
+        parked- only used on a root. Set while the tree is sleeping on a wait node, until the timing wheel wakes it
+            or the wait is aborted.
+        *observers- only used on a root. The reactive composites whose guards are being watched, outermost first.
     */
 typedef struct nodehead
 {
@@ -69,8 +168,25 @@ typedef struct nodehead
     Action start;
     Action tick;
     char *label;
+    int finalized;
+    int evaluable;
+    int parked;
+    void *observers;
 } Node;
 
+/*
+    Structured error filled in by behaviour_tree_finalize.
+        code- what went wrong, BE_NONE if the tree is valid.
+        *node- the offending node.
+        *message- a static, human readable description of the error.
+    */
+typedef struct
+{
+    BehaviourErrorCode code;
+    Node *node;
+    const char *message;
+} BehaviourError;
+
 /* 
     Structure for the leaf node. "inherits" the head structure of the node, and adds some extra leaf-specific fields:
         head- the base class of the leaf node.
@@ -117,58 +233,298 @@ typedef struct repeaternode_t
 /*
     Structure of a composite node, identical between fallback and sequence.
         child_count- number of children a node has. Used for space allocation, iteration and assertions.
-        current_child_index- when iterating over the internal child array, this keeps track of where it's up to.
         **children- the internal child array.
     */
 typedef struct compositenode_t
 {
     Node head;
     int child_count;
-    int current_child_index;
     Node **children;
 } CompositeNode;
 
-typedef int (*Job)(Node *node_handle, void *param_v_1, void *param_v_2);
+/*
+    Structure of the reactive sequence and fallback nodes. Starts the same as a composite node, so it can be cast to one.
+    While focus is inside one of its children, the children before it are its guards and are re-evaluated in one go
+    to check they still hold. A guard that changes its mind preempts the running child.
+    Only evaluable children are guards. Children with a repeater or timer node in them just run as normal, and
+    aren't re-checked once they've finished.
+        running_child- index of the child focus is inside of.
+        guard_rate- guards are re-checked every guard_rate tree ticks. 0 to only re-check when the version changes.
+        ticks_until_check- tree ticks left until the next re-check.
+        *guard_version- optional counter the caller bumps when the guards' inputs change, causing a re-check.
+        seen_version- the value of *guard_version at the last re-check.
+        observing- set while the node is on its root's observer list.
+        *next_observer- the next, further in, observer on the root's list.
+    */
+typedef struct reactivenode_t
+{
+    Node head;
+    int child_count;
+    Node **children;
+    int running_child;
+    int guard_rate;
+    int ticks_until_check;
+    unsigned long *guard_version;
+    unsigned long seen_version;
+    int observing;
+    struct reactivenode_t *next_observer;
+} ReactiveNode;
+
+typedef int (*Visitor)(Node *node_handle, int depth, void *user_data);
+typedef int (*Wake)(Node *root_node_handle, void *user_data);
+typedef BlackboardValue (*Merge)(BlackboardValue current, BlackboardValue incoming);
+
+/*
+    A write deferred until the end of the frame.
+        slot- the slot being written.
+        key- stable id of whoever made the write, i.e a tree or agent id. Orders writes from different callers.
+        sequence- position of the write in its writer's buffer. Orders writes from the same caller.
+        value- the value written to it.
+    */
+typedef struct blackboardwrite_t
+{
+    int slot;
+    unsigned long key;
+    int sequence;
+    BlackboardValue value;
+} BlackboardWrite;
+
+/*
+    A per-thread buffer of deferred writes. Only the thread that owns a writer writes to it, so it needs no locking.
+        *blackboard- the blackboard the writes are for.
+        write_count- number of writes buffered this frame.
+        write_capacity- number of writes the buffer has space for.
+        *writes- the buffered writes, in the order they were made.
+    */
+typedef struct blackboardwriter_t
+{
+    struct blackboard_t *blackboard;
+    int write_count;
+    int write_capacity;
+    BlackboardWrite *writes;
+} BlackboardWriter;
+
+/*
+    Double buffered blackboard shared between trees ticked on several threads.
+    During a frame every read comes from the front buffer, which nothing writes to, so reads are plain loads.
+    At the end of the frame behaviour_blackboard_swap builds the back buffer from the front and the deferred writes,
+    then swaps the two.
+        slot_count- number of slots in each buffer.
+        *front- the buffer read from during the frame.
+        *back- the buffer the next frame is built in.
+        policy, merge- how conflicting writes to a slot are resolved.
+        generation- bumped every swap, and stamped into written[slot] when a slot is written, for BC_FIRST_WRITE_WINS.
+        *written- the generation each slot was last written in.
+        writer_count, writer_capacity, **writers- every writer created for this blackboard, in creation order.
+        pending_capacity, *pending- scratch buffer the writers' writes are gathered and sorted in during a swap.
+    */
+typedef struct blackboard_t
+{
+    int slot_count;
+    BlackboardValue *front;
+    BlackboardValue *back;
+    BlackboardConflict policy;
+    Merge merge;
+    unsigned int generation;
+    unsigned int *written;
+    int writer_count;
+    int writer_capacity;
+    BlackboardWriter **writers;
+    int pending_capacity;
+    BlackboardWrite *pending;
+} Blackboard;
+
+/*
+    An entry in a timing wheel slot. Slots are circular doubly linked lists with a sentinel entry
+    as their head, so an entry can be cancelled in O(1).
+        *next, *prev- neighbours in the slot, NULL when the entry isn't scheduled.
+        deadline- the time the entry expires at.
+        *node- the timer node that owns this entry.
+    */
+typedef struct timerentry_t
+{
+    struct timerentry_t *next;
+    struct timerentry_t *prev;
+    unsigned long deadline;
+    Node *node;
+} TimerEntry;
+
+/*
+    Hierarchical timing wheel. Time is supplied by the caller through behaviour_wheel_advance, in whatever
+    unit they like (milliseconds or frames), so runs are deterministic.
+        now- the time the wheel was last advanced to. Timer nodes read the clock from here.
+        current- the next time unit the wheel hasn't processed yet.
+        slots- the sentinels of every slot on every level.
+        wake, *wake_data- the callback and its argument for the advance currently in progress.
+        woken- number of trees woken during the advance currently in progress.
+    */
+typedef struct timingwheel_t
+{
+    unsigned long now;
+    unsigned long current;
+    TimerEntry slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    Wake wake;
+    void *wake_data;
+    int woken;
+} TimingWheel;
+
+/*
+    Structure of the wait, timeout and cooldown nodes. Decorators whose timing comes from a timing wheel.
+        head- base class of the timer nodes.
+        *child- the decorated node. Same position as in DecoratorNode, so timer nodes can be cast to it.
+        *wheel- the wheel the node schedules on and reads the time from.
+        duration- how long to wait for, allow the child to run for, or cool down for.
+        ready_at- cooldown only. The time the child can next be started, kept across resets.
+        entry- the node's slot in the wheel. Waits park the tree on it, timeouts preempt the child when it expires.
+    */
+typedef struct timernode_t
+{
+    Node head;
+    Node *child;
+    TimingWheel *wheel;
+    unsigned long duration;
+    unsigned long ready_at;
+    TimerEntry entry;
+} TimerNode;
+
+/*
+    A frame on the explicit stack of behaviour_tree_visit. Children are walked by index held here,
+    so the walk never writes to the nodes themselves and can run alongside a tick.
+        *node- the node this frame belongs to.
+        next_child- index of the next child of node to walk into.
+        depth- depth of node below the visit root.
+    */
+typedef struct traversalframe_t
+{
+    Node *node;
+    int next_child;
+    int depth;
+} TraversalFrame;
+
+/*
+    Parameters for the finalize validation visitor.
+        *root- the root the tree is being finalized from, used to detect cycles back to it.
+        *error- where the first error found is reported.
+    */
+typedef struct validationcontext_t
+{
+    Node *root;
+    BehaviourError *error;
+} ValidationContext;
 
 /* --------------------------- internal functions --------------------------- */
 
-// takes a composite node and returns 1 if there is another child in its array, 0 if not.
-extern int       behaviour_node_internal_is_next_child(CompositeNode *node_handle);
-// takes a composite node and returns the next child in its array.
-extern Node *    behaviour_node_internal_get_next_child(CompositeNode *node_handle);
-// takes a composite node and resets its index to -1 (the start).
-extern int       behaviour_node_internal_reset_child_index(CompositeNode *node_handle);
+// takes a node and returns how many children it has. Leaves have 0, decorators 0 or 1.
+extern int       behaviour_node_internal_get_child_count(Node *node_handle);
+// takes a node and an index and returns that child, without touching the node's state.
+extern Node *    behaviour_node_internal_get_child(Node *node_handle, int index);
 
-// takes a job function, a target node, and 2 variable void pointers for arguments. Runs the job on the node and its subtree.
-extern int       behaviour_node_internal_recursive_dispatcher(Job job_handle, Node *node_handle, void *param_v_1, void *param_v_2);
 // takes a node and returns its state.
 extern NodeState behaviour_node_internal_get_state(Node *node_handle);
 // takes a node and returns its parent.
 extern Node *    behaviour_node_internal_get_parent(Node *node_handle);
-// takes a node and resets its state to NS_PENDING, the pre-start state.
-extern int       behaviour_node_internal_reset_state(Node *node_handle, void *a1, void *a2);
-// a job function that when called in the recursive dispatcher, sets the entire subtree root to root_node_handle.
-extern int       behaviour_node_internal_set_root(Node *node_handle, void *root_node_handle, void *a2);
+// fills in a BehaviourError. Always returns 0 so visitors can return it directly.
+extern int       behaviour_node_internal_set_error(BehaviourError *error_handle, BehaviourErrorCode code, Node *node_handle, const char *message);
+// a visitor that validates a node and the links to its children. Takes a ValidationContext, returns 0 on the first problem.
+extern int       behaviour_node_internal_validate(Node *node_handle, int depth, void *context_handle);
+// clears finalized on a node and its ancestors. Called by anything that changes a field finalize checks.
+extern int       behaviour_node_internal_invalidate(Node *node_handle);
+// a post order visitor that marks a node as finalized and works out if it is evaluable, once validation has passed.
+extern int       behaviour_node_internal_mark_finalized(Node *node_handle, int depth, void *a);
+// a visitor that resets a node's state to NS_PENDING, the pre-start state.
+extern int       behaviour_node_internal_reset_state(Node *node_handle, int depth, void *a);
+// a visitor that cancels a node's timer and returns it to NS_PENDING, without detaching it from its root.
+extern int       behaviour_node_internal_abort_state(Node *node_handle, int depth, void *a);
+// a visitor that, when run over a subtree, sets the entire subtree root to root_node_handle.
+extern int       behaviour_node_internal_set_root(Node *node_handle, int depth, void *root_node_handle);
 
 // takes a node and sets its root nodes focus to the pointer passed.
 extern int       behaviour_node_internal_move_focus(void *node_handle);
-// the standard node start function. Performs lots of assertions then sets state to NS_UNDETERMINED.
+// the standard node start function. Performs lots of assertions (checked engine only) then sets state to NS_UNDETERMINED.
 extern int       behaviour_node_internal_standard_start(void *node_handle);
 // decorator handler. takes a decorator node and determines what to do depending on type and child state.
 extern int       behaviour_node_internal_decorator_tick(void *node_handle);
+// timer node start function. Waits park the tree, timeouts start their clock and cooldowns fail if still cooling down.
+extern int       behaviour_node_internal_timer_start(void *node_handle);
+// timer node handler. Moves focus into the child once any wait is over, and finishes with the child's state.
+extern int       behaviour_node_internal_timer_tick(void *node_handle);
+// called by the wheel when a timer node's entry expires. Wakes parked trees and fails timed out children.
+extern int       behaviour_node_internal_timer_expire(Node *node_handle);
+// stops the running leaf if it is beneath node_handle and returns the whole subtree to NS_PENDING. Focus is left to the caller.
+extern int       behaviour_node_internal_preempt(Node *node_handle);
+// adds a reactive composite to the end of its root's observer list, watching the guards before running_child.
+extern int       behaviour_node_internal_start_observing(ReactiveNode *node_handle, int running_child);
+// removes a reactive composite, and every observer further in than it, from its root's observer list.
+extern int       behaviour_node_internal_stop_observing(ReactiveNode *node_handle);
+// evaluates a guard subtree to completion in one go, re-ticking its leaves. Returns NS_UNDETERMINED if a leaf is still running.
+extern NodeState behaviour_node_internal_evaluate_guard(Node *node_handle);
+// re-checks the guards of every observer that is due. Preempts and returns 1 if a guard changed, 0 if not.
+extern int       behaviour_node_internal_check_observers(Node *root_node_handle);
 // composite handles. takes a composite node and determines what to do depending on type and child state.
 extern int       behaviour_node_internal_composite_tick(void *node_handle);
 
+/* ------------------------- internal wheel functions ----------------------- */
+
+// links an entry into the slot for deadline. Entries further out than WHEEL_RANGE are placed in the last slot and re-scheduled on expiry.
+extern int       behaviour_wheel_internal_schedule(TimingWheel *wheel_handle, TimerEntry *entry_handle, unsigned long deadline);
+// unlinks an entry from its slot. Does nothing if the entry isn't scheduled.
+extern int       behaviour_wheel_internal_cancel(TimerEntry *entry_handle);
+// moves every entry in the current slot of a level down to the finer levels. Returns the slot index.
+extern int       behaviour_wheel_internal_cascade(TimingWheel *wheel_handle, int level);
+
+/* ---------------------- internal blackboard functions --------------------- */
+
+// applies one deferred write to the back buffer, following the blackboard's conflict policy.
+extern int       behaviour_blackboard_internal_apply(Blackboard *blackboard_handle, BlackboardWrite *write_handle);
+// qsort comparator ordering writes by slot, then key, then sequence.
+extern int       behaviour_blackboard_internal_compare_writes(const void *a, const void *b);
+
 /* ------------------------- external tree functions ------------------------ */
 
+// validates the whole tree once, reporting the first problem through error_handle. Returns 1 if the tree can be ticked.
+extern int       behaviour_tree_finalize(Node *root_node_handle, BehaviourError *error_handle);
 // resets the behaviour tree to default nodes with no root affiliation.
 extern int       behaviour_tree_reset(Node *root_node_handle);
+// walks the tree without recursion or writing to nodes, calling visitor on each node in the given order.
+// max_depth < 0 is unlimited. Returns 1 if the walk completed, 0 if the visitor stopped it.
+extern int       behaviour_tree_visit(Node *root_node_handle, TraversalOrder order, int max_depth, Visitor visitor_handle, void *user_data);
 // ticks the behaviour tree, for use in game loops to step through tree one instruction at a time.
 extern int       behaviour_tree_tick(Node *root_node_handle);
 // returns the node state of the tree at that moment.
 extern int       behaviour_tree_get_state(Node *root_node_handle);
-// executes the entire tree in one go.
+// executes the entire tree in one go. Returns -1 if the tree parks on a wait node, as only ticking can outlast a wait.
 extern int       behaviour_tree_run(Node *root_node_handle);
+// returns 1 if the tree is sleeping on a wait node. Parked trees don't need ticking until the wheel wakes them.
+extern int       behaviour_tree_is_parked(Node *root_node_handle);
+
+/* ------------------------ external wheel functions ------------------------ */
+
+// creates a timing wheel whose clock starts at now.
+extern TimingWheel *behaviour_wheel_create(unsigned long now);
+// moves the wheel's clock forward to now, expiring timers on the way. wake_handle (may be NULL) is called for each tree woken.
+// Returns the number of trees woken.
+extern int       behaviour_wheel_advance(TimingWheel *wheel_handle, unsigned long now, Wake wake_handle, void *user_data);
+// returns the time the wheel was last advanced to.
+extern unsigned long behaviour_wheel_get_time(TimingWheel *wheel_handle);
+
+/* ---------------------- external blackboard functions --------------------- */
+
+// creates a zeroed blackboard of slot_count slots. merge_handle is only used, and required, with BC_MERGE.
+extern Blackboard *behaviour_blackboard_create(int slot_count, BlackboardConflict policy, Merge merge_handle);
+// creates a writer for one thread. Which writer a write goes through doesn't change the order it is applied in.
+// Not thread safe, create every writer before ticking starts.
+extern BlackboardWriter *behaviour_blackboard_create_writer(Blackboard *blackboard_handle);
+// reads a slot as it was at the start of the frame. Safe from any thread while nothing is swapping.
+extern BlackboardValue behaviour_blackboard_read(Blackboard *blackboard_handle, int slot);
+// defers a write to a slot until the end of the frame. Only call from the thread that owns the writer.
+extern int       behaviour_blackboard_write(BlackboardWriter *writer_handle, unsigned long key, int slot, BlackboardValue value);
+// merges every writer's deferred writes in (slot, key, sequence) order and makes them visible.
+// Call once a frame, when no tree is being ticked.
+extern int       behaviour_blackboard_swap(Blackboard *blackboard_handle);
+// binds a writer to the calling thread, so leaves can find it with behaviour_blackboard_get_writer.
+extern int       behaviour_blackboard_bind_writer(BlackboardWriter *writer_handle);
+// returns the writer bound to the calling thread, NULL if there isn't one.
+extern BlackboardWriter *behaviour_blackboard_get_writer(void);
 
 /* ------------------------- external node functions ------------------------ */
 
@@ -197,8 +553,19 @@ extern int       behaviour_node_set_blackboard(Node *node_handle, void *blackboa
 extern void *    behaviour_node_get_subject(Node *node_handle);
 // Gets the blackboard of a behaviour node. Takes a node pointer.
 extern void *    behaviour_node_get_blackboard(Node *node_handle);
+// Gets the number of children of a node. Leaves have none, decorators at most one.
+extern int       behaviour_node_get_child_count(Node *node_handle);
+// Gets the child of a node at index, for walking a tree by hand. Takes a node and an index below the child count.
+extern Node *    behaviour_node_get_child(Node *node_handle, int index);
 // Sets the repetitions of a repeater node. Takes a node and a number of repetitions.
 extern int       behaviour_node_set_repetitions(Node *node_handle, int repetitions);
+// Sets the timing wheel and duration of a wait, timeout or cooldown node.
+extern int       behaviour_node_set_timer(Node *node_handle, TimingWheel *wheel_handle, unsigned long duration);
+// Sets how many tree ticks a reactive node waits between re-checking its guards. 0 to only re-check on a version change,
+// which needs a guard version set too.
+extern int       behaviour_node_set_guard_rate(Node *node_handle, int guard_rate);
+// Sets a counter the caller bumps whenever the inputs of a reactive node's guards change. NULL to stop watching it.
+extern int       behaviour_node_set_guard_version(Node *node_handle, unsigned long *version_handle);
 // Prints some debug information on a node, used for santity checking.
 extern int       behaviour_node_get_information(Node *node_handle);
 
@@ -3,4 +3,14 @@
 
 #define ASSERT_MSG(COND, MSG) ({if(COND){printf(MSG" (%s:%d)\n", __FILE__, __LINE__); exit(EXIT_FAILURE);} })
 
+/*
+    Hot path assertions. These are compiled out when building the unchecked engine (BEHAVIOUR_UNCHECKED),
+    where behaviour_tree_finalize is relied upon to validate the tree once before it is ticked.
+    */
+#ifdef BEHAVIOUR_UNCHECKED
+#define CHECK_MSG(COND, MSG) ((void)0)
+#else
+#define CHECK_MSG(COND, MSG) ASSERT_MSG(COND, MSG)
+#endif
+
 #endif // !MESSAGE_ASSERTIONS_INTERNAL_H
\ No newline at end of file
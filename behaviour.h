@@ -12,18 +12,91 @@ typedef enum
     NT_SEQUENCE,
     NT_REPEATER,
     NT_INVERTER,
+    NT_WAIT,
+    NT_TIMEOUT,
+    NT_COOLDOWN,
+    NT_REACTIVE_SEQUENCE,
+    NT_REACTIVE_FALLBACK,
     NT_COUNT
 } NodeType;
 
+typedef enum
+{
+    TO_PRE_ORDER = 0,
+    TO_POST_ORDER
+} TraversalOrder;
+
+typedef enum
+{
+    BE_NONE = 0,
+    BE_NULL_NODE,
+    BE_CYCLE,
+    BE_SHARED_CHILD,
+    BE_MISSING_ACTION,
+    BE_EMPTY_COMPOSITE,
+    BE_DECORATOR_NO_CHILD,
+    BE_UNSET_REPETITIONS,
+    BE_MISSING_WHEEL,
+    BE_GUARD_NEVER_CHECKED,
+    BE_COUNT
+} BehaviourErrorCode;
+
+typedef enum
+{
+    BC_LAST_WRITE_WINS = 0,
+    BC_FIRST_WRITE_WINS,
+    BC_MERGE,
+    BC_COUNT
+} BlackboardConflict;
+
+typedef union
+{
+    long integer;
+    double real;
+    void *pointer;
+} BlackboardValue;
+
 typedef struct n Node;
+typedef struct w TimingWheel;
+typedef struct b Blackboard;
+typedef struct bw BlackboardWriter;
 typedef int (*Action)(void *node_handle);
+typedef int (*Visitor)(Node *node_handle, int depth, void *user_data);
+typedef int (*Wake)(Node *root_node_handle, void *user_data);
+typedef BlackboardValue (*Merge)(BlackboardValue current, BlackboardValue incoming);
+
+typedef struct
+{
+    BehaviourErrorCode code;
+    Node *node;
+    const char *message;
+} BehaviourError;
 
 /* ------------------------- external tree functions ------------------------ */
 
+extern int       behaviour_tree_finalize(Node *root_node_handle, BehaviourError *error_handle);
 extern int       behaviour_tree_reset(Node *root_node_handle);
+extern int       behaviour_tree_visit(Node *root_node_handle, TraversalOrder order, int max_depth, Visitor visitor_handle, void *user_data);
 extern int       behaviour_tree_tick(Node *root_node_handle);
 extern int       behaviour_tree_get_state(Node *root_node_handle);
 extern int       behaviour_tree_run(Node *root_node_handle);
+extern int       behaviour_tree_is_parked(Node *root_node_handle);
+
+/* ------------------------ external wheel functions ------------------------ */
+
+extern TimingWheel *behaviour_wheel_create(unsigned long now);
+extern int       behaviour_wheel_advance(TimingWheel *wheel_handle, unsigned long now, Wake wake_handle, void *user_data);
+extern unsigned long behaviour_wheel_get_time(TimingWheel *wheel_handle);
+
+/* ---------------------- external blackboard functions --------------------- */
+
+extern Blackboard *behaviour_blackboard_create(int slot_count, BlackboardConflict policy, Merge merge_handle);
+extern BlackboardWriter *behaviour_blackboard_create_writer(Blackboard *blackboard_handle);
+extern BlackboardValue behaviour_blackboard_read(Blackboard *blackboard_handle, int slot);
+extern int       behaviour_blackboard_write(BlackboardWriter *writer_handle, unsigned long key, int slot, BlackboardValue value);
+extern int       behaviour_blackboard_swap(Blackboard *blackboard_handle);
+extern int       behaviour_blackboard_bind_writer(BlackboardWriter *writer_handle);
+extern BlackboardWriter *behaviour_blackboard_get_writer(void);
 
 /* ------------------------- external node functions ------------------------ */
 
@@ -41,7 +114,12 @@ extern int       behaviour_node_set_subject(Node *node_handle, void *subject_han
 extern int       behaviour_node_set_blackboard(Node *node_handle, void *blackboard_handle);
 extern void *    behaviour_node_get_subject(Node *node_handle);
 extern void *    behaviour_node_get_blackboard(Node *node_handle);
+extern int       behaviour_node_get_child_count(Node *node_handle);
+extern Node *    behaviour_node_get_child(Node *node_handle, int index);
 extern int       behaviour_node_set_repetitions(Node *node_handle, int repetitions);
+extern int       behaviour_node_set_timer(Node *node_handle, TimingWheel *wheel_handle, unsigned long duration);
+extern int       behaviour_node_set_guard_rate(Node *node_handle, int guard_rate);
+extern int       behaviour_node_set_guard_version(Node *node_handle, unsigned long *version_handle);
 extern int       behaviour_node_get_information(Node *node_handle);
 
 #endif // !BEHAVIOUR_H
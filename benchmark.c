@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "behaviour.h"
+
+/*
+    100k agents that each sleep for 1-5 seconds, do a unit of work, and go back to sleep, forever.
+    Simulated for 20 seconds at 60 frames a second, with the clock in milliseconds.
+
+    polling- a sequence of a sleep leaf, which stays running and compares timestamps, and the work.
+        Every tree is ticked every frame.
+    wheel- a wait node decorating the work. A sleeping tree is parked on the timing wheel and only
+        ticked again once the wheel wakes it.
+
+    Both check deadlines against the same millisecond frame clock. An awake tree is ticked until it goes
+    back to sleep within the frame, so both variants wake on the same frames and do the same work.
+    */
+
+#define AGENTS 100000
+#define FRAMES 1200
+#define FRAME_MS 16
+
+typedef struct
+{
+    unsigned long duration;
+    unsigned long wake_at;
+} Agent;
+
+typedef struct
+{
+    Node **roots;
+    int count;
+} ActiveList;
+
+unsigned long clock_ms = 0;
+unsigned long work_done = 0;
+unsigned long ticks = 0;
+int sleeping = 0;
+
+int work(void *node_handle)
+{
+    work_done++;
+    SUCCEED(node_handle);
+}
+
+int poll_sleep_start(void *node_handle)
+{
+    Agent *agent = behaviour_node_get_subject(node_handle);
+    agent->wake_at = clock_ms + agent->duration;
+    return 1;
+}
+
+int poll_sleep(void *node_handle)
+{
+    Agent *agent = behaviour_node_get_subject(node_handle);
+    if (clock_ms < agent->wake_at)
+    {
+        sleeping = 1;
+        RUN(node_handle);
+    }
+    SUCCEED(node_handle);
+}
+
+int wake(Node *root_node_handle, void *user_data)
+{
+    ActiveList *active = user_data;
+    active->roots[active->count++] = root_node_handle;
+    return 1;
+}
+
+double seconds_since(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+Node *create_work(void)
+{
+    Node *leaf = behaviour_node_create(NT_LEAF);
+    behaviour_node_set_action(leaf, &work);
+    return leaf;
+}
+
+Node *create_forever(Node *child)
+{
+    Node *repeater = behaviour_node_create(NT_REPEATER);
+    behaviour_node_set_repetitions(repeater, -1);
+    behaviour_node_add_child(repeater, child);
+    return repeater;
+}
+
+void benchmark_polling(Agent *agents)
+{
+    Node **roots = malloc(sizeof(Node *) * AGENTS);
+    struct timespec start;
+    int frame, i;
+
+    for (i = 0; i < AGENTS; i++)
+    {
+        Node *sequence = behaviour_node_create(NT_SEQUENCE);
+        Node *sleep = behaviour_node_create(NT_LEAF);
+        behaviour_node_set_start(sleep, &poll_sleep_start);
+        behaviour_node_set_action(sleep, &poll_sleep);
+        behaviour_node_set_subject(sleep, &agents[i]);
+        behaviour_node_add_child(sequence, sleep);
+        behaviour_node_add_child(sequence, create_work());
+        roots[i] = create_forever(sequence);
+    }
+
+    clock_ms = 0;
+    work_done = 0;
+    ticks = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (frame = 0; frame < FRAMES; frame++)
+    {
+        clock_ms += FRAME_MS;
+        for (i = 0; i < AGENTS; i++)
+        {
+            sleeping = 0;
+            while (!sleeping)
+            {
+                behaviour_tree_tick(roots[i]);
+                ticks++;
+            }
+        }
+    }
+    printf("polling: %.3fs, %lu ticks, %lu units of work\n", seconds_since(&start), ticks, work_done);
+    free(roots);
+}
+
+void benchmark_wheel(Agent *agents)
+{
+    TimingWheel *wheel = behaviour_wheel_create(0);
+    ActiveList active = {malloc(sizeof(Node *) * AGENTS), 0};
+    struct timespec start;
+    int frame, i;
+
+    for (i = 0; i < AGENTS; i++)
+    {
+        Node *sleep = behaviour_node_create(NT_WAIT);
+        behaviour_node_set_timer(sleep, wheel, agents[i].duration);
+        behaviour_node_add_child(sleep, create_work());
+        active.roots[active.count++] = create_forever(sleep);
+    }
+
+    clock_ms = 0;
+    work_done = 0;
+    ticks = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (frame = 0; frame < FRAMES; frame++)
+    {
+        clock_ms += FRAME_MS;
+        behaviour_wheel_advance(wheel, clock_ms, &wake, &active);
+
+        // tick every awake tree until it parks again. Every tree parks within the frame, so the list empties.
+        for (i = 0; i < active.count; i++)
+        {
+            while (!behaviour_tree_is_parked(active.roots[i]))
+            {
+                behaviour_tree_tick(active.roots[i]);
+                ticks++;
+            }
+        }
+        active.count = 0;
+    }
+    printf("wheel:   %.3fs, %lu ticks, %lu units of work\n", seconds_since(&start), ticks, work_done);
+    free(active.roots);
+}
+
+int main(int argc, char **argv)
+{
+    Agent *agents = malloc(sizeof(Agent) * AGENTS);
+    int i;
+
+    srand(1);
+    for (i = 0; i < AGENTS; i++)
+        agents[i].duration = 1000 + rand() % 4000;
+
+    benchmark_polling(agents);
+    benchmark_wheel(agents);
+
+    free(agents);
+    return 0;
+}